@@ -208,6 +208,9 @@ public:
  * @arg assoc       - cache associativity level
  * @arg missCount   - count how many times the cache has been accssessed, yet the requested block was not found
  * @arg hitCount    - count how many times the cache has been accssessed, and the requested block was found
+ * @arg warm_since  - block access time the cache state is trusted from, -1 if it is trusted from the beginning
+ * @arg coldHitCount  - hits to blocks not accessed since warm_since, they may have been evicted by then
+ * @arg coldMissCount - misses to sets not filled since warm_since, the block may have still been there
  * */
 class Cache{
     vector<CacheEntry> cache_data;
@@ -216,11 +219,18 @@ class Cache{
     int assoc;
     double missCount;
     double hitCount;
+    int warm_since;
+    double coldHitCount;
+    double coldMissCount;
+    void countColdAccess(const uint32_t addr, bool hit);
 public:
     int block_size;
     Cache(int cache_size, int block_size, int assoc): cache_size(pow(2, cache_size)), block_size(pow(2, block_size)), assoc(pow(2,assoc)){
         missCount = 0;
         hitCount = 0;
+        warm_since = -1;
+        coldHitCount = 0;
+        coldMissCount = 0;
         for(int i = 0 ; i < this->assoc ; i++){
             cache_data.push_back(CacheEntry(this->cache_size / (this->block_size * this->assoc)));
         }
@@ -237,6 +247,11 @@ public:
     void updateValue(double* miss_rate) { *miss_rate = missCount / (missCount + hitCount) ;}
     double calculateMissRate() { return missCount / (missCount + hitCount); } /* Need to verify the equation */
     double calculateHitRate(){ return 1 - calculateMissRate(); }
+    double getMissCount()const { return missCount; }
+    double getHitCount()const { return hitCount; }
+    void setWarmSince(int time) { warm_since = time; }
+    double getColdHitCount()const { return coldHitCount; }
+    double getColdMissCount()const { return coldMissCount; }
     double averageAccessTime();
 };
 
@@ -248,10 +263,12 @@ bool Cache::isBlockInCache(const uint32_t addr){
         vector<CacheEntry>::iterator line = cache_data.begin();
         for(line ; line != cache_data.end(); line++){
             if(getBlockIDByAddr(addr, block_size) == getBlockIDByAddr(line->getLine()[0].getFirstAddr(), block_size)){
+                countColdAccess(addr, true);
                 hitCount++;
                 return true;
             }
         }
+        countColdAccess(addr, false);
         missCount++;
         return false;
     }
@@ -261,19 +278,34 @@ bool Cache::isBlockInCache(const uint32_t addr){
             vector<Block>::iterator block = line->getLine().begin();
             for(block; block != line->getLine().end(); block++){
                 if(getBlockIDByAddr(addr, block_size) == getBlockIDByAddr(line->getLine()[addr_set].getFirstAddr(), block_size)){ 
+                    countColdAccess(addr, true);
                     hitCount++;
                     return true;
                 } 
             }
         }
+        countColdAccess(addr, false);
         missCount++;
         return false;
     }
+    countColdAccess(addr, false);
     missCount++;
     return false;
 }
 
 
+void Cache::countColdAccess(const uint32_t addr, bool hit){
+    if(warm_since < 0) return;
+    if(hit){
+        if(getBlockFromAddr(addr).getLastAccess() < warm_since) coldHitCount++;
+    }
+    else{
+        // with LRU, a set whose blocks were all accessed since warm_since would have evicted the block anyway
+        Block lru_block = get_LRU_BlockFromSameLine(addr);
+        if(lru_block.getBlockID() == -1 || lru_block.getLastAccess() < warm_since) coldMissCount++;
+    }
+}
+
 bool Cache::snoopHigherCache(const uint32_t addr){
     int addr_set = getSetBits(addr, assoc, block_size, cache_size);
     int addr_tag = getTagBits(addr, assoc, block_size, cache_size);
@@ -4,7 +4,10 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <memory>
 #include "cache.h"
+#include "sampling.h"
+#include "tlb.h"
 
 using std::FILE;
 using std::string;
@@ -17,6 +20,13 @@ using std::stringstream;
 #define NO_WRITE_ALLOCATE 0
 #define WRITE_ALLOCATE 1
 
+/**
+ * printEstimateBounds(): print the confidence bounds of a sampled estimate, n/a if they are unknown
+ * */
+void printEstimateBounds(const char* name, const SampleEstimate& estimate){
+	if(estimate.bounded) printf("%s=[%.03f,%.03f] ", name, estimate.low, estimate.high);
+	else printf("%s=n/a ", name);
+}
 
 int main(int argc, char **argv) {
 
@@ -25,6 +35,11 @@ int main(int argc, char **argv) {
 		return 0;
 	}
 	// Get input arguments
+	// optional arguments come in pairs as well
+	if (argc % 2 != 0) {
+		cerr << "Error in arguments" << endl;
+		return 0;
+	}
 
 	// File
 	// Assuming it is the first argument
@@ -42,9 +57,17 @@ int main(int argc, char **argv) {
 
 	int ic = 0 ; //instruction count
 	int totalAccTime = 0;
+	SampleConfig sampleConfig; //sampling mode is off unless --sample-interval is given
+	bool sampleArgs = false; //other --sample-* arguments are given
+
+	//address translation is off unless --page-size is given, a TLB level exists only if its entries are given
+	int PageSize = 0, WalkLevels = 2;
+	int TLB1Entries = -1, TLB1Assoc = 0, TLB1Cyc = 0, TLB2Entries = -1, TLB2Assoc = 0, TLB2Cyc = 0;
+	uint32_t HugeStart = 0, HugeEnd = 0;
+	bool translationArgs = false; //arguments that only mean something with --page-size are given
 
 	//parse characteristics
-	for (int i = 2; i < 19; i += 2) {
+	for (int i = 2; i + 1 < argc; i += 2) {
 		string s(argv[i]);
 		if (s == "--mem-cyc") {
 			MemCyc = atoi(argv[i + 1]);
@@ -64,35 +87,98 @@ int main(int argc, char **argv) {
 			L2Assoc = atoi(argv[i + 1]);
 		} else if (s == "--wr-alloc") {
 			WrAlloc = atoi(argv[i + 1]);
+		} else if (s == "--sample-interval") {
+			sampleConfig.interval_len = atoi(argv[i + 1]);
+		} else if (s == "--sample-clusters") {
+			sampleConfig.num_clusters = atoi(argv[i + 1]);
+			sampleArgs = true;
+		} else if (s == "--sample-per-cluster") {
+			sampleConfig.per_cluster = atoi(argv[i + 1]);
+			sampleArgs = true;
+		} else if (s == "--sample-warmup") {
+			sampleConfig.warmup_len = atoi(argv[i + 1]);
+			sampleArgs = true;
+		} else if (s == "--sample-region-bits") {
+			sampleConfig.region_bits = atoi(argv[i + 1]);
+			sampleArgs = true;
+		} else if (s == "--sample-seed") {
+			sampleConfig.seed = strtoul(argv[i + 1], NULL, 10);
+			sampleArgs = true;
+		} else if (s == "--page-size") {
+			PageSize = atoi(argv[i + 1]);
+		} else if (s == "--walk-levels") {
+			WalkLevels = atoi(argv[i + 1]);
+			translationArgs = true;
+		} else if (s == "--huge-start") {
+			HugeStart = strtoul(argv[i + 1], NULL, 16);
+			translationArgs = true;
+		} else if (s == "--huge-end") {
+			HugeEnd = strtoul(argv[i + 1], NULL, 16);
+			translationArgs = true;
+		} else if (s == "--tlb1-entries") {
+			TLB1Entries = atoi(argv[i + 1]);
+			translationArgs = true;
+		} else if (s == "--tlb1-assoc") {
+			TLB1Assoc = atoi(argv[i + 1]);
+			translationArgs = true;
+		} else if (s == "--tlb1-cyc") {
+			TLB1Cyc = atoi(argv[i + 1]);
+			translationArgs = true;
+		} else if (s == "--tlb2-entries") {
+			TLB2Entries = atoi(argv[i + 1]);
+			translationArgs = true;
+		} else if (s == "--tlb2-assoc") {
+			TLB2Assoc = atoi(argv[i + 1]);
+			translationArgs = true;
+		} else if (s == "--tlb2-cyc") {
+			TLB2Cyc = atoi(argv[i + 1]);
+			translationArgs = true;
 		} else {
 			cerr << "Error in arguments" << endl;
 			return 0;
 		}
 	}
 
+	//TLB sizes are log2 like the caches, a TLB can't have more ways than entries
+	if (PageSize < 0 || PageSize >= ADDR_BITS || (PageSize == 0 && translationArgs)
+			|| WalkLevels < 1 || WalkLevels > ADDR_BITS - PageSize
+			|| TLB1Entries < -1 || TLB1Entries >= ADDR_BITS || TLB1Assoc < 0 || TLB1Assoc > max(TLB1Entries, 0) || TLB1Cyc < 0
+			|| TLB2Entries < -1 || TLB2Entries >= ADDR_BITS || TLB2Assoc < 0 || TLB2Assoc > max(TLB2Entries, 0) || TLB2Cyc < 0
+			|| HugeEnd < HugeStart || (HugeEnd > HugeStart && WalkLevels < 2)) {
+		cerr << "Error in arguments" << endl;
+		return 0;
+	}
+
+	if (sampleConfig.interval_len < 0 || (sampleConfig.interval_len == 0 && sampleArgs) || sampleConfig.num_clusters < 1
+			|| sampleConfig.per_cluster < 1 || sampleConfig.warmup_len < -1
+			|| sampleConfig.region_bits < 0 || sampleConfig.region_bits >= 32) {
+		cerr << "Error in arguments" << endl;
+		return 0;
+	}
+
 	Cache L1(L1Size, BSize, L1Assoc);
 	Cache L2(L2Size, BSize, L2Assoc);
-	
-	while (getline(file, line)) {
-		stringstream ss(line);
-		string address;
-		char operation = 0; // read (R) or write (W)
-		if (!(ss >> operation >> address)) {
-			// Operation appears in an Invalid format
-			cout << "Command Format error" << endl;
+	unique_ptr<MMU> mmu; //exists only when address translation is on
+	if (PageSize != 0) {
+		mmu.reset(new MMU(PageSize, WalkLevels, HugeStart, HugeEnd));
+		if(TLB1Entries >= 0) mmu->addTLB(TLB1Entries, TLB1Assoc, TLB1Cyc);
+		if(TLB2Entries >= 0) mmu->addTLB(TLB2Entries, TLB2Assoc, TLB2Cyc);
+		uint32_t hugeMask = (1u << mmu->getHugePageBits()) - 1;
+		if ((HugeStart & hugeMask) || (HugeEnd & hugeMask)) {
+			// the huge range must be made of whole huge pages
+			cerr << "Error in arguments" << endl;
 			return 0;
 		}
+	}
 
-		string cutAddress = address.substr(2); // Removing the "0x" part of the address
-
-		unsigned long int num = 0;
-		num = strtoul(cutAddress.c_str(), NULL, 16);
-		
+	// simulate a single access through L1 and L2, returns the access time
+	auto accessMemory = [&](char operation, uint32_t num) -> int {
+		int accTime = 0;
 		if(operation == 'w'){
 			if(WrAlloc == WRITE_ALLOCATE){
 				if(L1.isBlockInCache(num)){ 							 /* Is Block in L1 Cache? */
 					L1.getBlockFromAddr(num).writeToBlock();
-					totalAccTime += L1Cyc;
+					accTime += L1Cyc;
 				}
 				else if(L2.isBlockInCache(num)){						 /* Is Block in L2 Cache? */
 					Block _block1 = L1.get_LRU_BlockFromSameLine(num);
@@ -107,8 +193,8 @@ int main(int argc, char **argv) {
 						}
 					}
 
-					totalAccTime += L1Cyc;
-					totalAccTime += L2Cyc;
+					accTime += L1Cyc;
+					accTime += L2Cyc;
 				}
 				
 				else{
@@ -124,7 +210,7 @@ int main(int argc, char **argv) {
 						}
 						if(_block2.isBlockDirty()){
 							/* update memory*/
-							// totalAccTime += MemCyc;
+							// accTime += MemCyc;
 						}
 						L2.removeBlock(_block2);
 					}
@@ -139,9 +225,9 @@ int main(int argc, char **argv) {
 						}
 					}
 
-					totalAccTime += L1Cyc;
-					totalAccTime += L2Cyc;
-					totalAccTime += MemCyc;
+					accTime += L1Cyc;
+					accTime += L2Cyc;
+					accTime += MemCyc;
 				}
 			}
 			else if(WrAlloc == NO_WRITE_ALLOCATE){
@@ -153,17 +239,17 @@ int main(int argc, char **argv) {
 					if(L2.isBlockInCache(num)){							/* Is Block in L2 Cache? */
 						L2.getBlockFromAddr(num).writeToBlock();
 					}
-					else totalAccTime += MemCyc;						/* block is in memory */
-					totalAccTime += L2Cyc;
+					else accTime += MemCyc;						/* block is in memory */
+					accTime += L2Cyc;
 				}
-				totalAccTime += L1Cyc;
+				accTime += L1Cyc;
 			}
 		}
 		
 		else if(operation == 'r'){
 			if(L1.isBlockInCache(num)){ 							 /* Is Block in L1 Cache? */
 				L1.getBlockFromAddr(num).readBlock();
-				totalAccTime += L1Cyc;
+				accTime += L1Cyc;
 			}
 			else if(L2.isBlockInCache(num)){						/* Is Block in L2 Cache? */
 				L2.getBlockFromAddr(num).readBlock();
@@ -175,8 +261,8 @@ int main(int argc, char **argv) {
 						L2.updateBlock(_block1);
 					}
 				}
-				totalAccTime += L1Cyc;
-				totalAccTime += L2Cyc;
+				accTime += L1Cyc;
+				accTime += L2Cyc;
 			}
 			
 			else{
@@ -192,7 +278,7 @@ int main(int argc, char **argv) {
 					}
 					if(_block2.isBlockDirty()){
 						/* update memory*/
-						// totalAccTime += MemCyc;
+						// accTime += MemCyc;
 					}
 					L2.removeBlock(_block2);
 				}
@@ -205,11 +291,60 @@ int main(int argc, char **argv) {
 						L2.updateBlock(_block1);
 					}
 				}
-				totalAccTime += L1Cyc;
-				totalAccTime += L2Cyc;
-				totalAccTime += MemCyc;
+				accTime += L1Cyc;
+				accTime += L2Cyc;
+				accTime += MemCyc;
 			}
 		}
+		return accTime;
+	};
+
+	// translate a trace address, the page walk reads go through L1 and L2 as well
+	auto accessVirtual = [&](char operation, uint32_t num) -> int {
+		int accTime = 0;
+		if(mmu) num = mmu->translate(num, accessMemory, &accTime);
+		return accTime + accessMemory(operation, num);
+	};
+
+	if(sampleConfig.interval_len > 0){
+		SampleResult res;
+		if(!runSampledSimulation(file, L1, L2, mmu.get(), accessVirtual, sampleConfig, &res)){
+			cout << "Command Format error" << endl;
+			return 0;
+		}
+
+		printf("L1miss=%.03f ", res.L1miss.value);
+		printf("L2miss=%.03f ", res.L2miss.value);
+		printf("AccTimeAvg=%.03f\n", res.AccTimeAvg.value);
+		if(mmu){
+			for(int i = 0 ; i < (int)res.TLBmiss.size() ; i++){
+				printf("TLB%dmiss=%.03f ", i + 1, res.TLBmiss[i].value);
+			}
+			printf("WalkCycAvg=%.03f\n", res.WalkCycAvg.value);
+		}
+		printEstimateBounds("L1missCI", res.L1miss);
+		printEstimateBounds("L2missCI", res.L2miss);
+		printEstimateBounds("AccTimeAvgCI", res.AccTimeAvg);
+		for(int i = 0 ; i < (int)res.TLBmiss.size() ; i++){
+			string name = "TLB" + to_string(i + 1) + "missCI";
+			printEstimateBounds(name.c_str(), res.TLBmiss[i]);
+		}
+		if(mmu) printEstimateBounds("WalkCycAvgCI", res.WalkCycAvg);
+		printf("Intervals=%d/%d SimAccesses=%d/%d\n", res.sim_intervals, res.total_intervals,
+				res.sim_accesses, res.total_accesses);
+		return 0;
+	}
+
+	while (getline(file, line)) {
+		char operation = 0; // read (R) or write (W)
+		uint32_t num = 0;
+		if (!parseTraceLine(line, &operation, &num)) {
+			// Operation appears in an Invalid format
+			cout << "Command Format error" << endl;
+			return 0;
+		}
+
+		totalAccTime += accessVirtual(operation, num);
 		ic++;
 	}
 
@@ -225,6 +360,14 @@ int main(int argc, char **argv) {
 	printf("L1miss=%.03f ", L1MissRate);
 	printf("L2miss=%.03f ", L2MissRate);
 	printf("AccTimeAvg=%.03f\n", avgAccTime);
+	if(mmu){
+		for(int i = 0 ; i < mmu->getNumTLBs() ; i++){
+			printf("TLB%dmiss=%.03f ", i + 1, mmu->getTLBMissRate(i));
+		}
+		printf("Walks=%.0f ", mmu->getWalkCount());
+		printf("WalkCyc=%.0f ", mmu->getWalkCycles());
+		printf("WalkCycAvg=%.03f\n", (mmu->getWalkCount() > 0) ? mmu->getWalkCycles() / mmu->getWalkCount() : 0);
+	}
 
 	return 0;
 }
@@ -0,0 +1,603 @@
+#ifndef SAMPLING_H_
+#define SAMPLING_H_
+
+
+#include <vector>
+#include <algorithm>
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <random>
+#include <math.h>
+#include <stdint.h>
+#include <limits.h>
+#include <stdlib.h>
+#include "cache.h"
+#include "tlb.h"
+
+using namespace std;
+#define SAMPLE_VECTOR_BITS 6                        // log2 of the number of dimensions in an interval vector
+#define SAMPLE_VECTOR_DIMS (1 << SAMPLE_VECTOR_BITS)
+#define SAMPLE_MAX_ITERATIONS 100                   // k-means iterations limit
+#define SAMPLE_CONFIDENCE_Z 1.96                    // 95% confidence bounds, normal quantile
+
+/**
+ * parseTraceLine(): parse a single line of the trace file
+ * @param line - the line, "<r|w> 0x<hex address>"
+ * @param operation - output, read ('r') or write ('w')
+ * @param addr - output, the accessed address
+ * @return - FALSE if the line is not in the trace format
+ * */
+bool parseTraceLine(const string& line, char* operation, uint32_t* addr){
+    stringstream ss(line);
+    string address;
+    *operation = 0;
+    if (!(ss >> *operation >> address)) return false;
+    string cutAddress = address.substr(2); // Removing the "0x" part of the address
+    *addr = strtoul(cutAddress.c_str(), NULL, 16);
+    return true;
+}
+
+/**
+ * SampleConfig struct - sampling mode parameters
+ * @arg interval_len    - number of accesses in each interval, 0 means sampling is off (full simulation)
+ * @arg num_clusters    - maximal number of clusters (program phases) the intervals are split into
+ * @arg per_cluster     - number of intervals simulated from each cluster
+ * @arg warmup_len      - number of accesses simulated before each chosen interval only to warm up the caches
+ * @arg region_bits     - log2 of the address region size used to build the interval vectors
+ * @arg seed            - seed of the random draw of the non-representative intervals
+ * */
+struct SampleConfig{
+    int interval_len;
+    int num_clusters;
+    int per_cluster;
+    int warmup_len;
+    int region_bits;
+    unsigned seed;
+    SampleConfig(): interval_len(0), num_clusters(10), per_cluster(2), warmup_len(-1), region_bits(12), seed(1){}
+};
+
+/**
+ * SampleCounters struct - snapshot of the simulation counters, used to measure a single interval
+ * */
+struct SampleCounters{
+    double L1Miss;
+    double L1Hit;
+    double L1ColdMiss;
+    double L1ColdHit;
+    double L2Miss;
+    double L2Hit;
+    double L2ColdMiss;
+    double L2ColdHit;
+    vector<double> TLBMiss;
+    vector<double> TLBHit;
+    vector<double> TLBColdMiss;
+    vector<double> TLBColdHit;
+    double walks;
+    double walkCycles;
+    double cycles;
+};
+
+/**
+ * SampleEstimate struct - weighted estimate of a statistic and its confidence bounds
+ * @arg bounded - FALSE if there were not enough measured intervals to estimate the error, low/high are meaningless
+ * */
+struct SampleEstimate{
+    double value;
+    double low;
+    double high;
+    bool bounded;
+    SampleEstimate(): value(0), low(0), high(0), bounded(true){}
+};
+
+/**
+ * SampleResult struct - the output of a sampled simulation
+ * @arg TLBmiss         - miss rate of each TLB level, empty if address translation is off
+ * @arg WalkCycAvg      - average access time of a page walk
+ * @arg sim_intervals   - number of intervals that were measured
+ * @arg sim_accesses    - number of accesses that went through the caches, warm-up included
+ * */
+struct SampleResult{
+    SampleEstimate L1miss;
+    SampleEstimate L2miss;
+    SampleEstimate AccTimeAvg;
+    vector<SampleEstimate> TLBmiss;
+    SampleEstimate WalkCycAvg;
+    int sim_intervals;
+    int total_intervals;
+    int sim_accesses;
+    int total_accesses;
+    SampleResult(): sim_intervals(0), total_intervals(0), sim_accesses(0), total_accesses(0){}
+};
+
+/**
+ * takeSnapshot(): read the current counters of the caches and the TLBs
+ * @param L1 - first level cache
+ * @param L2 - second level cache
+ * @param mmu - the TLBs and page walker, NULL if address translation is off
+ * @param cycles - access time accumulated so far
+ * @return - counters snapshot
+ * */
+SampleCounters takeSnapshot(const Cache& L1, const Cache& L2, const MMU* mmu, double cycles){
+    SampleCounters counters;
+    counters.L1Miss = L1.getMissCount();
+    counters.L1Hit = L1.getHitCount();
+    counters.L1ColdMiss = L1.getColdMissCount();
+    counters.L1ColdHit = L1.getColdHitCount();
+    counters.L2Miss = L2.getMissCount();
+    counters.L2Hit = L2.getHitCount();
+    counters.L2ColdMiss = L2.getColdMissCount();
+    counters.L2ColdHit = L2.getColdHitCount();
+    counters.walks = 0;
+    counters.walkCycles = 0;
+    if(mmu != NULL){
+        for(int i = 0 ; i < mmu->getNumTLBs() ; i++){
+            counters.TLBMiss.push_back(mmu->getTLBMissCount(i));
+            counters.TLBHit.push_back(mmu->getTLBHitCount(i));
+            counters.TLBColdMiss.push_back(mmu->getTLBColdMissCount(i));
+            counters.TLBColdHit.push_back(mmu->getTLBColdHitCount(i));
+        }
+        counters.walks = mmu->getWalkCount();
+        counters.walkCycles = mmu->getWalkCycles();
+    }
+    counters.cycles = cycles;
+    return counters;
+}
+
+/**
+ * getColdCount(): count the cold accesses of the caches and the TLBs so far
+ * @param L1 - first level cache
+ * @param L2 - second level cache
+ * @param mmu - the TLBs and page walker, NULL if address translation is off
+ * @return - number of cold hits and misses
+ * */
+double getColdCount(const Cache& L1, const Cache& L2, const MMU* mmu){
+    double count = L1.getColdHitCount() + L1.getColdMissCount() + L2.getColdHitCount() + L2.getColdMissCount();
+    if(mmu != NULL){
+        for(int i = 0 ; i < mmu->getNumTLBs() ; i++){
+            count += mmu->getTLBColdHitCount(i) + mmu->getTLBColdMissCount(i);
+        }
+    }
+    return count;
+}
+
+/**
+ * getRegionBucket(): calculate to which dimension of the interval vector, does the given addr belongs to
+ * @param addr - current address
+ * @param region_bits - log2 of the address region size
+ * @return - dimension index, hashed from the region number
+ * */
+int getRegionBucket(const uint32_t addr, int region_bits){
+    uint32_t region = addr >> region_bits;
+    return (uint32_t)(region * 2654435761u) >> (32 - SAMPLE_VECTOR_BITS);
+}
+
+/**
+ * vectorDistance(): squared euclidean distance between two interval vectors
+ * */
+double vectorDistance(const vector<double>& a, const vector<double>& b){
+    double dist = 0;
+    for(int i = 0 ; i < (int)a.size() ; i++){
+        dist += (a[i] - b[i]) * (a[i] - b[i]);
+    }
+    return dist;
+}
+
+/**
+ * buildIntervalVectors(): first pass over the trace file. split it into fixed length intervals and describe
+ * each one by the normalized distribution of its accesses between the address regions
+ * @param file - the trace file, read from its current position to the end
+ * @param interval_len - number of accesses in each interval (the last one may be shorter)
+ * @param region_bits - log2 of the address region size
+ * @param vectors - output, a vector for each interval
+ * @param offsets - output, file position of the first access of each interval
+ * @param total_accesses - output, number of accesses in the trace
+ * @return - FALSE if a line is not in the trace format
+ * */
+bool buildIntervalVectors(ifstream& file, int interval_len, int region_bits, vector<vector<double> >* vectors,
+                          vector<streampos>* offsets, int* total_accesses){
+    string line;
+    char operation;
+    uint32_t addr;
+    int count = 0;
+    for(streampos pos = file.tellg() ; getline(file, line) ; pos = file.tellg()){
+        if(!parseTraceLine(line, &operation, &addr)) return false;
+        if(count % interval_len == 0){
+            vectors->push_back(vector<double>(SAMPLE_VECTOR_DIMS, 0));
+            offsets->push_back(pos);
+        }
+        vectors->back()[getRegionBucket(addr, region_bits)]++;
+        count++;
+    }
+    for(int i = 0 ; i < (int)vectors->size() ; i++){
+        double len = min(count - i * interval_len, interval_len);
+        for(int j = 0 ; j < SAMPLE_VECTOR_DIMS ; j++){
+            (*vectors)[i][j] /= len;
+        }
+    }
+    *total_accesses = count;
+    return true;
+}
+
+/**
+ * clusterIntervals(): group similar intervals using k-means, initialized with farthest-first centers
+ * so the result is deterministic
+ * @param vectors - interval vectors
+ * @param num_clusters - maximal number of clusters
+ * @return - cluster number of each interval. cluster numbers are 0..k-1 and none of them is empty
+ * */
+vector<int> clusterIntervals(const vector<vector<double> >& vectors, int num_clusters){
+    int n = vectors.size();
+    vector<vector<double> > centers;
+    vector<double> nearest(n, INFINITY);
+    int next_center = 0;
+    while((int)centers.size() < num_clusters){
+        centers.push_back(vectors[next_center]);
+        double farthest = 0;
+        for(int i = 0 ; i < n ; i++){
+            nearest[i] = min(nearest[i], vectorDistance(vectors[i], centers.back()));
+            if(nearest[i] > farthest){
+                farthest = nearest[i];
+                next_center = i;
+            }
+        }
+        if(farthest == 0) break;    // every interval is already identical to one of the centers
+    }
+
+    vector<int> assignment(n, -1);
+    for(int iter = 0 ; iter < SAMPLE_MAX_ITERATIONS ; iter++){
+        bool changed = false;
+        for(int i = 0 ; i < n ; i++){
+            int best = 0;
+            double best_dist = vectorDistance(vectors[i], centers[0]);
+            for(int c = 1 ; c < (int)centers.size() ; c++){
+                double dist = vectorDistance(vectors[i], centers[c]);
+                if(dist < best_dist){
+                    best = c;
+                    best_dist = dist;
+                }
+            }
+            if(assignment[i] != best){
+                assignment[i] = best;
+                changed = true;
+            }
+        }
+        if(!changed) break;
+
+        vector<int> sizes(centers.size(), 0);
+        vector<vector<double> > sums(centers.size(), vector<double>(SAMPLE_VECTOR_DIMS, 0));
+        for(int i = 0 ; i < n ; i++){
+            sizes[assignment[i]]++;
+            for(int j = 0 ; j < SAMPLE_VECTOR_DIMS ; j++) sums[assignment[i]][j] += vectors[i][j];
+        }
+        for(int c = 0 ; c < (int)centers.size() ; c++){
+            if(sizes[c] == 0) continue;     // empty cluster keeps its old center
+            for(int j = 0 ; j < SAMPLE_VECTOR_DIMS ; j++) centers[c][j] = sums[c][j] / sizes[c];
+        }
+    }
+
+    // renumber the clusters so empty ones are dropped
+    vector<int> new_id(centers.size(), -1);
+    int num_used = 0;
+    for(int i = 0 ; i < n ; i++){
+        if(new_id[assignment[i]] == -1) new_id[assignment[i]] = num_used++;
+        assignment[i] = new_id[assignment[i]];
+    }
+    return assignment;
+}
+
+/**
+ * chooseIntervals(): pick the intervals to simulate from each cluster - the one closest to the cluster's
+ * center (the representative), and more intervals drawn at random from the rest of the cluster, so their
+ * spread can be used to estimate the error
+ * @param vectors - interval vectors
+ * @param assignment - cluster number of each interval
+ * @param num_clusters - number of clusters
+ * @param per_cluster - number of intervals to pick from each cluster
+ * @param seed - seed of the random draw, the same seed picks the same intervals
+ * @return - chosen intervals, in trace order
+ * */
+vector<int> chooseIntervals(const vector<vector<double> >& vectors, const vector<int>& assignment,
+                            int num_clusters, int per_cluster, unsigned seed){
+    mt19937 generator(seed);
+    vector<vector<int> > members(num_clusters);
+    for(int i = 0 ; i < (int)assignment.size() ; i++){
+        members[assignment[i]].push_back(i);
+    }
+
+    vector<int> chosen;
+    for(int c = 0 ; c < num_clusters ; c++){
+        vector<double> center(SAMPLE_VECTOR_DIMS, 0);
+        for(int k = 0 ; k < (int)members[c].size() ; k++){
+            for(int j = 0 ; j < SAMPLE_VECTOR_DIMS ; j++) center[j] += vectors[members[c][k]][j] / members[c].size();
+        }
+        int representative = 0;
+        for(int k = 1 ; k < (int)members[c].size() ; k++){
+            if(vectorDistance(vectors[members[c][k]], center) < vectorDistance(vectors[members[c][representative]], center)){
+                representative = k;
+            }
+        }
+        chosen.push_back(members[c][representative]);
+
+        vector<int> others = members[c];
+        others.erase(others.begin() + representative);
+        int extra = min(per_cluster, (int)members[c].size()) - 1;
+        for(int k = 0 ; k < extra ; k++){
+            // partial Fisher-Yates shuffle
+            int pick = k + generator() % (others.size() - k);
+            swap(others[k], others[pick]);
+            chosen.push_back(others[k]);
+        }
+    }
+    sort(chosen.begin(), chosen.end());
+    return chosen;
+}
+
+/**
+ * tQuantile(): two sided 95% quantile of the Student-t distribution
+ * @param df - degrees of freedom, at least 1
+ * @return - the quantile, taken from a table up to 30 degrees and from the Cornish-Fisher expansion above it
+ * */
+double tQuantile(int df){
+    static const double table[30] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                                     2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+                                     2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+    if(df <= 30) return table[df - 1];
+    double z = SAMPLE_CONFIDENCE_Z;
+    return z + (pow(z, 3) + z) / (4 * df) + (5 * pow(z, 5) + 16 * pow(z, 3) + 3 * z) / (96 * df * df);
+}
+
+/**
+ * estimateRatio(): stratified ratio estimate of sum(y) / sum(x) over the whole trace, where each cluster
+ * is a stratum and the measured intervals are its samples
+ * @param y - numerator measured in each simulated interval (e.g. misses)
+ * @param x - denominator measured in each simulated interval (e.g. accesses)
+ * @param strata - cluster number of each simulated interval
+ * @param stratum_sizes - total number of intervals in each cluster
+ * @return - the estimate and its confidence bounds, using the Student-t quantile of the pooled degrees of
+ * freedom. clusters with a single measured interval use the variance pooled from the other clusters.
+ * the bounds are unknown if a partly measured cluster has no variance to use, or a zero variance taken
+ * from only two intervals
+ * */
+SampleEstimate estimateRatio(const vector<double>& y, const vector<double>& x, const vector<int>& strata,
+                             const vector<int>& stratum_sizes){
+    int num_strata = stratum_sizes.size();
+    vector<double> sum_y(num_strata, 0), sum_x(num_strata, 0);
+    vector<int> count(num_strata, 0);
+    for(int i = 0 ; i < (int)y.size() ; i++){
+        sum_y[strata[i]] += y[i];
+        sum_x[strata[i]] += x[i];
+        count[strata[i]]++;
+    }
+    double total_y = 0, total_x = 0;
+    for(int h = 0 ; h < num_strata ; h++){
+        if(count[h] == 0) continue;
+        total_y += stratum_sizes[h] * sum_y[h] / count[h];
+        total_x += stratum_sizes[h] * sum_x[h] / count[h];
+    }
+    SampleEstimate estimate;
+    if(total_x == 0) return estimate;
+    estimate.value = total_y / total_x;
+
+    // variance of the residuals y - R*x in each stratum
+    vector<double> mean_r(num_strata, 0), var_r(num_strata, 0);
+    for(int i = 0 ; i < (int)y.size() ; i++){
+        mean_r[strata[i]] += (y[i] - estimate.value * x[i]) / count[strata[i]];
+    }
+    for(int i = 0 ; i < (int)y.size() ; i++){
+        double r = y[i] - estimate.value * x[i] - mean_r[strata[i]];
+        var_r[strata[i]] += r * r;
+    }
+    double pooled = 0;
+    int pooled_df = 0;
+    for(int h = 0 ; h < num_strata ; h++){
+        if(count[h] < 2) continue;
+        pooled += var_r[h];
+        pooled_df += count[h] - 1;
+        var_r[h] /= count[h] - 1;
+    }
+    if(pooled_df > 0) pooled /= pooled_df;
+
+    double variance = 0;
+    for(int h = 0 ; h < num_strata ; h++){
+        if(count[h] == 0) continue;
+        double N = stratum_sizes[h];
+        if(count[h] == N) continue;     // the whole cluster was measured
+        double s2 = (count[h] < 2) ? pooled : var_r[h];
+        int df = (count[h] < 2) ? pooled_df : count[h] - 1;
+        if(df == 0 || (s2 == 0 && df < 2)){
+            // nothing to take the variance from, or two measured intervals happen to be identical
+            estimate.bounded = false;
+            return estimate;
+        }
+        variance += N * N * (1 - count[h] / N) * s2 / count[h];
+    }
+    double half_width = (pooled_df > 0) ? tQuantile(pooled_df) * sqrt(variance) / total_x : 0;
+    estimate.low = max(0.0, estimate.value - half_width);
+    estimate.high = estimate.value + half_width;
+    return estimate;
+}
+
+/**
+ * combineBounds(): widen the sampling bounds of an estimate by the cold start error
+ * @param measured - estimate of the measured values
+ * @param optimistic - estimate of the same values with the cold accesses counted as hits
+ * @param pessimistic - estimate of the same values with the cold accesses counted as misses
+ * @return - the measured estimate, with bounds covering all three
+ * */
+SampleEstimate combineBounds(const SampleEstimate& measured, const SampleEstimate& optimistic,
+                             const SampleEstimate& pessimistic){
+    SampleEstimate estimate = measured;
+    estimate.bounded = measured.bounded && optimistic.bounded && pessimistic.bounded;
+    estimate.low = min(measured.low, min(optimistic.low, pessimistic.low));
+    estimate.high = max(measured.high, max(optimistic.high, pessimistic.high));
+    return estimate;
+}
+
+/**
+ * seekToAccess(): move the trace file to the given access, using the offsets of the intervals
+ * @param file - the trace file
+ * @param offsets - file position of the first access of each interval
+ * @param interval_len - number of accesses in each interval
+ * @param target - number of the access to move to
+ * @param current - number of the access the file is at, updated
+ * */
+void seekToAccess(ifstream& file, const vector<streampos>& offsets, int interval_len, int target, int* current){
+    if(*current == target) return;
+    file.clear();
+    file.seekg(offsets[target / interval_len]);
+    *current = (target / interval_len) * interval_len;
+    string line;
+    while(*current < target && getline(file, line)) (*current)++;
+}
+
+/**
+ * runSampledSimulation(): simulate only the chosen intervals of the trace and estimate the statistics of
+ * the whole trace. the file is read twice - once to cluster the intervals, and once to simulate the chosen
+ * ones. before each chosen interval, up to warmup_len accesses are simulated only to warm up the caches,
+ * all other accesses are skipped. the bounds cover both the sampling error and the cold start error of the
+ * skipped parts, except for WalkCycAvg whose bounds cover the sampling error only
+ * @param file - the trace file, at its beginning
+ * @param L1 - first level cache
+ * @param L2 - second level cache
+ * @param mmu - the TLBs and page walker used by access, NULL if address translation is off
+ * @param access - callable (operation, addr) that simulates a single access and returns its access time
+ * @param config - sampling parameters
+ * @param result - output, weighted estimates of L1miss, L2miss, AccTimeAvg, the TLB miss rates and WalkCycAvg
+ * @return - FALSE if a line is not in the trace format
+ * */
+template<class AccessFunc>
+bool runSampledSimulation(ifstream& file, Cache& L1, Cache& L2, MMU* mmu, AccessFunc access,
+                          const SampleConfig& config, SampleResult* result){
+    int interval_len = config.interval_len;
+    int warmup_len = (config.warmup_len < 0) ? interval_len : config.warmup_len;
+    vector<vector<double> > vectors;
+    vector<streampos> offsets;
+    if(!buildIntervalVectors(file, interval_len, config.region_bits, &vectors, &offsets, &result->total_accesses)){
+        return false;
+    }
+    if(vectors.empty()) return true;
+
+    vector<int> assignment = clusterIntervals(vectors, config.num_clusters);
+    int num_clusters = *max_element(assignment.begin(), assignment.end()) + 1;
+    vector<int> cluster_sizes(num_clusters, 0);
+    for(int i = 0 ; i < (int)assignment.size() ; i++) cluster_sizes[assignment[i]]++;
+    vector<int> chosen = chooseIntervals(vectors, assignment, num_clusters, config.per_cluster, config.seed);
+
+    // measured per interval. after a skipped part of the trace the caches count cold accesses, which may
+    // behave differently in a full simulation. the "Opt" values count cold misses as hits, and the "Pes"
+    // values count cold hits as misses
+    vector<double> L1Miss, L1Acc, L2Miss, L2Acc, cycles, accesses;
+    vector<double> L1MissOpt, L1MissPes, L2MissOpt, L2MissPes, L2AccOpt, L2AccPes, coldCycles, coldCount;
+    int num_tlbs = (mmu != NULL) ? mmu->getNumTLBs() : 0;
+    vector<vector<double> > TLBMiss(num_tlbs), TLBAcc(num_tlbs), TLBMissOpt(num_tlbs), TLBMissPes(num_tlbs),
+                            TLBAccOpt(num_tlbs), TLBAccPes(num_tlbs);
+    vector<double> walks, walkCycles;
+    vector<int> strata;
+    int min_cycles = INT_MAX, max_cycles = 0;
+    int simulated_upto = 0;
+    int current = -1;       // the file is at its end after the first pass
+    double total_cycles = 0;
+    string line;
+    char operation;
+    uint32_t addr;
+    for(int k = 0 ; k < (int)chosen.size() ; k++){
+        int start = chosen[k] * interval_len;
+        int end = min(result->total_accesses, start + interval_len);
+        int warm_start = max(simulated_upto, start - warmup_len);
+        if(warm_start != simulated_upto){
+            L1.setWarmSince(current_time);
+            L2.setWarmSince(current_time);
+            if(mmu != NULL) mmu->setWarmSince();
+        }
+        seekToAccess(file, offsets, interval_len, warm_start, &current);
+        for( ; current < start && getline(file, line) ; current++){
+            if(!parseTraceLine(line, &operation, &addr)) return false;
+            int acc_time = access(operation, addr);
+            total_cycles += acc_time;
+            min_cycles = min(min_cycles, acc_time);
+            max_cycles = max(max_cycles, acc_time);
+        }
+        SampleCounters before = takeSnapshot(L1, L2, mmu, total_cycles);
+        double cold_cycles = 0, cold_count = 0;
+        for( ; current < end && getline(file, line) ; current++){
+            if(!parseTraceLine(line, &operation, &addr)) return false;
+            double cold_before = getColdCount(L1, L2, mmu);
+            int acc_time = access(operation, addr);
+            total_cycles += acc_time;
+            min_cycles = min(min_cycles, acc_time);
+            max_cycles = max(max_cycles, acc_time);
+            if(getColdCount(L1, L2, mmu) > cold_before){
+                cold_cycles += acc_time;
+                cold_count++;
+            }
+        }
+        SampleCounters after = takeSnapshot(L1, L2, mmu, total_cycles);
+
+        double L1_cold_miss = after.L1ColdMiss - before.L1ColdMiss, L1_cold_hit = after.L1ColdHit - before.L1ColdHit;
+        double L2_cold_miss = after.L2ColdMiss - before.L2ColdMiss, L2_cold_hit = after.L2ColdHit - before.L2ColdHit;
+        L1Miss.push_back(after.L1Miss - before.L1Miss);
+        L1MissOpt.push_back(L1Miss.back() - L1_cold_miss);
+        L1MissPes.push_back(L1Miss.back() + L1_cold_hit);
+        L1Acc.push_back(after.L1Miss + after.L1Hit - before.L1Miss - before.L1Hit);
+        L2Miss.push_back(after.L2Miss - before.L2Miss);
+        L2MissOpt.push_back(L2Miss.back() - L2_cold_miss);
+        L2MissPes.push_back(L2Miss.back() + L2_cold_hit + L1_cold_hit);
+        L2Acc.push_back(after.L2Miss + after.L2Hit - before.L2Miss - before.L2Hit);
+        L2AccOpt.push_back(max(0.0, L2Acc.back() - L1_cold_miss));
+        L2AccPes.push_back(L2Acc.back() + L1_cold_hit);
+        // a TLB level is looked up only on a miss of the level before it, like L2
+        double upper_cold_miss = 0, upper_cold_hit = 0;
+        for(int i = 0 ; i < num_tlbs ; i++){
+            double cold_miss = after.TLBColdMiss[i] - before.TLBColdMiss[i];
+            double cold_hit = after.TLBColdHit[i] - before.TLBColdHit[i];
+            TLBMiss[i].push_back(after.TLBMiss[i] - before.TLBMiss[i]);
+            TLBMissOpt[i].push_back(TLBMiss[i].back() - cold_miss);
+            TLBMissPes[i].push_back(TLBMiss[i].back() + cold_hit + upper_cold_hit);
+            TLBAcc[i].push_back(after.TLBMiss[i] + after.TLBHit[i] - before.TLBMiss[i] - before.TLBHit[i]);
+            TLBAccOpt[i].push_back(max(0.0, TLBAcc[i].back() - upper_cold_miss));
+            TLBAccPes[i].push_back(TLBAcc[i].back() + upper_cold_hit);
+            upper_cold_miss += cold_miss;
+            upper_cold_hit += cold_hit;
+        }
+        walks.push_back(after.walks - before.walks);
+        walkCycles.push_back(after.walkCycles - before.walkCycles);
+        cycles.push_back(after.cycles - before.cycles);
+        coldCycles.push_back(cold_cycles);
+        coldCount.push_back(cold_count);
+        accesses.push_back(end - start);
+        strata.push_back(assignment[chosen[k]]);
+        result->sim_accesses += end - warm_start;
+        simulated_upto = end;
+    }
+
+    vector<double> cyclesOpt, cyclesPes;
+    for(int k = 0 ; k < (int)cycles.size() ; k++){
+        cyclesOpt.push_back(cycles[k] - coldCycles[k] + coldCount[k] * min_cycles);
+        cyclesPes.push_back(cycles[k] - coldCycles[k] + coldCount[k] * max_cycles);
+    }
+
+    result->L1miss = combineBounds(estimateRatio(L1Miss, L1Acc, strata, cluster_sizes),
+                                   estimateRatio(L1MissOpt, L1Acc, strata, cluster_sizes),
+                                   estimateRatio(L1MissPes, L1Acc, strata, cluster_sizes));
+    result->L2miss = combineBounds(estimateRatio(L2Miss, L2Acc, strata, cluster_sizes),
+                                   estimateRatio(L2MissOpt, L2AccOpt, strata, cluster_sizes),
+                                   estimateRatio(L2MissPes, L2AccPes, strata, cluster_sizes));
+    result->AccTimeAvg = combineBounds(estimateRatio(cycles, accesses, strata, cluster_sizes),
+                                       estimateRatio(cyclesOpt, accesses, strata, cluster_sizes),
+                                       estimateRatio(cyclesPes, accesses, strata, cluster_sizes));
+    for(int i = 0 ; i < num_tlbs ; i++){
+        result->TLBmiss.push_back(combineBounds(estimateRatio(TLBMiss[i], TLBAcc[i], strata, cluster_sizes),
+                                                estimateRatio(TLBMissOpt[i], TLBAccOpt[i], strata, cluster_sizes),
+                                                estimateRatio(TLBMissPes[i], TLBAccPes[i], strata, cluster_sizes)));
+        result->TLBmiss[i].high = min(1.0, result->TLBmiss[i].high);
+    }
+    result->WalkCycAvg = estimateRatio(walkCycles, walks, strata, cluster_sizes);
+    result->L1miss.high = min(1.0, result->L1miss.high);
+    result->L2miss.high = min(1.0, result->L2miss.high);
+    result->sim_intervals = chosen.size();
+    result->total_intervals = assignment.size();
+    return true;
+}
+
+#endif // _SAMPLING_H
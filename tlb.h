@@ -0,0 +1,282 @@
+#ifndef TLB_H_
+#define TLB_H_
+
+
+#include <vector>
+#include <map>
+#include <math.h>
+#include <stdint.h>
+
+using namespace std;
+#define PTE_SIZE 4      // bytes of a single page table entry
+#define ADDR_BITS 32
+
+/**
+ * TLBEntry struct - a single translation cached in a TLB
+ * @arg vpn         - virtual page number (counted in huge pages for a huge page entry)
+ * @arg phys_base   - first physical address of the page
+ * @arg huge        - TRUE if the entry maps a huge page
+ * @arg valid       - FALSE for an empty entry
+ * @arg last_access - used for LRU. recently accessed entries will have a greater number.
+ * */
+struct TLBEntry{
+    uint32_t vpn;
+    uint32_t phys_base;
+    bool huge;
+    bool valid;
+    int last_access;
+    TLBEntry(): vpn(0), phys_base(0), huge(false), valid(false), last_access(0){}
+};
+
+/**
+ * TLB class - set associative TLB with LRU replacement, holding both base and huge pages
+ * @arg sets        - vector of sets, each set is a vector of entries
+ * @arg num_sets
+ * @arg assoc       - TLB associativity level
+ * @arg page_bits   - log2 of the base page size
+ * @arg huge_bits   - log2 of the huge page size
+ * @arg access_time - cycles of a single lookup
+ * @arg lru_time    - counter for entries accessing
+ * @arg missCount   - count how many translations were not found
+ * @arg hitCount    - count how many translations were found
+ * @arg warm_since  - lru_time the TLB state is trusted from, -1 if it is trusted from the beginning
+ * @arg coldHitCount  - hits to entries not accessed since warm_since, they may have been evicted by then
+ * @arg coldMissCount - misses to sets not filled since warm_since, the translation may have still been there
+ * */
+class TLB{
+    vector<vector<TLBEntry> > sets;
+    int num_sets;
+    int assoc;
+    int page_bits;
+    int huge_bits;
+    int access_time;
+    int lru_time;
+    double missCount;
+    double hitCount;
+    int warm_since;
+    double coldHitCount;
+    double coldMissCount;
+    TLBEntry* findEntry(const uint32_t vaddr, bool huge);
+    bool isSetCold(const uint32_t vaddr, bool huge)const;
+public:
+    TLB(int entries, int assoc, int cycles, int page_bits, int huge_bits);
+    ~TLB() = default;
+    bool lookup(const uint32_t vaddr, TLBEntry* found); //increase hit or miss count
+    void insert(const uint32_t vaddr, bool huge, uint32_t phys_base);
+    int getAccessTime()const { return access_time; }
+    double calculateMissRate()const { return (missCount + hitCount > 0) ? missCount / (missCount + hitCount) : 0; }
+    double getMissCount()const { return missCount; }
+    double getHitCount()const { return hitCount; }
+    void setWarmSince() { warm_since = lru_time; }
+    double getColdHitCount()const { return coldHitCount; }
+    double getColdMissCount()const { return coldMissCount; }
+};
+
+TLB::TLB(int entries, int assoc, int cycles, int page_bits, int huge_bits): assoc(pow(2, assoc)), page_bits(page_bits),
+                                                        huge_bits(huge_bits), access_time(cycles), lru_time(0){
+    missCount = 0;
+    hitCount = 0;
+    warm_since = -1;
+    coldHitCount = 0;
+    coldMissCount = 0;
+    num_sets = pow(2, entries) / this->assoc;
+    if(num_sets < 1) num_sets = 1;
+    for(int i = 0 ; i < num_sets ; i++){
+        sets.push_back(vector<TLBEntry>(this->assoc));
+    }
+}
+
+TLBEntry* TLB::findEntry(const uint32_t vaddr, bool huge){
+    uint32_t vpn = vaddr >> (huge ? huge_bits : page_bits);
+    vector<TLBEntry>& set = sets[vpn % num_sets];
+    for(int i = 0 ; i < assoc ; i++){
+        if(set[i].valid && set[i].huge == huge && set[i].vpn == vpn) return &set[i];
+    }
+    return NULL;
+}
+
+bool TLB::isSetCold(const uint32_t vaddr, bool huge)const{
+    // with LRU, a set whose entries were all accessed since warm_since would have evicted the translation anyway
+    const vector<TLBEntry>& set = sets[(vaddr >> (huge ? huge_bits : page_bits)) % num_sets];
+    for(int i = 0 ; i < assoc ; i++){
+        if(!set[i].valid || set[i].last_access < warm_since) return true;
+    }
+    return false;
+}
+
+bool TLB::lookup(const uint32_t vaddr, TLBEntry* found){
+    TLBEntry* entry = findEntry(vaddr, false);
+    if(entry == NULL) entry = findEntry(vaddr, true);
+    if(entry == NULL){
+        if(warm_since >= 0 && (isSetCold(vaddr, false) || isSetCold(vaddr, true))) coldMissCount++;
+        missCount++;
+        return false;
+    }
+    if(warm_since >= 0 && entry->last_access < warm_since) coldHitCount++;
+    entry->last_access = lru_time++;
+    *found = *entry;
+    hitCount++;
+    return true;
+}
+
+void TLB::insert(const uint32_t vaddr, bool huge, uint32_t phys_base){
+    uint32_t vpn = vaddr >> (huge ? huge_bits : page_bits);
+    vector<TLBEntry>& set = sets[vpn % num_sets];
+    int victim = 0;
+    for(int i = 0 ; i < assoc ; i++){
+        if(!set[i].valid){
+            victim = i;
+            break;
+        }
+        if(set[i].last_access < set[victim].last_access) victim = i;
+    }
+    set[victim].vpn = vpn;
+    set[victim].phys_base = phys_base;
+    set[victim].huge = huge;
+    set[victim].valid = true;
+    set[victim].last_access = lru_time++;
+}
+
+/**
+ * MMU class - translates trace (virtual) addresses to physical addresses. looks the TLB levels up in order,
+ * and on a miss in all of them walks a radix page table whose entries are read through the caches.
+ * physical pages and page tables are allocated on first touch
+ * @arg tlbs        - TLB levels, tlbs[0] is looked up first
+ * @arg page_bits   - log2 of the base page size
+ * @arg huge_bits   - log2 of the huge page size, a huge page is mapped by the one before last walk level
+ * @arg level_bits  - number of virtual address bits translated by each walk level
+ * @arg level_shift - lowest virtual address bit translated by each walk level
+ * @arg huge_start  - virtual addresses in [huge_start, huge_end) are mapped with huge pages
+ * @arg huge_end
+ * @arg next_phys   - next free physical address
+ * @arg tables      - tables[l] maps the virtual address bits above level l to the physical address of its table
+ * @arg pages       - maps a virtual page number to its physical address
+ * @arg huge_pages  - maps a virtual huge page number to its physical address
+ * @arg walkCount   - number of page walks
+ * @arg walkCycles  - access time spent on page walks
+ * */
+class MMU{
+    vector<TLB> tlbs;
+    int page_bits;
+    int huge_bits;
+    vector<int> level_bits;
+    vector<int> level_shift;
+    uint32_t huge_start;
+    uint32_t huge_end;
+    uint32_t next_phys;
+    vector<map<uint32_t, uint32_t> > tables;
+    map<uint32_t, uint32_t> pages;
+    map<uint32_t, uint32_t> huge_pages;
+    double walkCount;
+    double walkCycles;
+    uint32_t allocPhys(uint32_t size, uint32_t align);
+    uint32_t getTable(int level, const uint32_t vaddr);
+public:
+    MMU(int page_bits, int walk_levels, uint32_t huge_start, uint32_t huge_end);
+    ~MMU() = default;
+    void addTLB(int entries, int assoc, int cycles);
+    bool isHugePage(const uint32_t vaddr)const;
+    template<class AccessFunc>
+    uint32_t translate(const uint32_t vaddr, AccessFunc access, int* acc_time);
+    int getNumTLBs()const { return tlbs.size(); }
+    int getHugePageBits()const { return huge_bits; }
+    double getTLBMissRate(int level)const { return tlbs[level].calculateMissRate(); }
+    double getWalkCount()const { return walkCount; }
+    double getWalkCycles()const { return walkCycles; }
+    double getTLBMissCount(int level)const { return tlbs[level].getMissCount(); }
+    double getTLBHitCount(int level)const { return tlbs[level].getHitCount(); }
+    double getTLBColdMissCount(int level)const { return tlbs[level].getColdMissCount(); }
+    double getTLBColdHitCount(int level)const { return tlbs[level].getColdHitCount(); }
+    void setWarmSince();
+};
+
+MMU::MMU(int page_bits, int walk_levels, uint32_t huge_start, uint32_t huge_end): page_bits(page_bits),
+                            huge_start(huge_start), huge_end(huge_end), next_phys(0), tables(walk_levels){
+    walkCount = 0;
+    walkCycles = 0;
+    // split the virtual page number between the levels, the top level takes the remainder
+    int vpn_bits = ADDR_BITS - page_bits;
+    int shift = ADDR_BITS;
+    for(int l = 0 ; l < walk_levels ; l++){
+        int bits = vpn_bits / walk_levels + (l == 0 ? vpn_bits % walk_levels : 0);
+        shift -= bits;
+        level_bits.push_back(bits);
+        level_shift.push_back(shift);
+    }
+    huge_bits = (walk_levels > 1) ? level_shift[walk_levels - 2] : page_bits;
+}
+
+void MMU::addTLB(int entries, int assoc, int cycles){
+    tlbs.push_back(TLB(entries, assoc, cycles, page_bits, huge_bits));
+}
+
+void MMU::setWarmSince(){
+    for(int i = 0 ; i < (int)tlbs.size() ; i++){
+        tlbs[i].setWarmSince();
+    }
+}
+
+bool MMU::isHugePage(const uint32_t vaddr)const{
+    if(huge_bits == page_bits) return false;
+    uint32_t base = (vaddr >> huge_bits) << huge_bits;
+    return (base >= huge_start && base < huge_end);
+}
+
+uint32_t MMU::allocPhys(uint32_t size, uint32_t align){
+    next_phys = (next_phys + align - 1) & ~(align - 1);
+    uint32_t base = next_phys;
+    next_phys += size;
+    return base;
+}
+
+uint32_t MMU::getTable(int level, const uint32_t vaddr){
+    uint32_t key = (level == 0) ? 0 : vaddr >> level_shift[level - 1];
+    map<uint32_t, uint32_t>::iterator table = tables[level].find(key);
+    if(table != tables[level].end()) return table->second;
+    uint32_t page_size = 1u << page_bits;
+    uint32_t base = allocPhys(max((uint32_t)PTE_SIZE << level_bits[level], page_size), page_size);
+    tables[level][key] = base;
+    return base;
+}
+
+template<class AccessFunc>
+uint32_t MMU::translate(const uint32_t vaddr, AccessFunc access, int* acc_time){
+    TLBEntry entry;
+    int hit_level = tlbs.size();
+    for(int i = 0 ; i < (int)tlbs.size() ; i++){
+        *acc_time += tlbs[i].getAccessTime();
+        if(tlbs[i].lookup(vaddr, &entry)){
+            hit_level = i;
+            break;
+        }
+    }
+
+    if(hit_level == (int)tlbs.size()){
+        // missed all TLB levels - walk the page table, every level reads one entry through the caches
+        bool huge = isHugePage(vaddr);
+        int last_level = level_bits.size() - (huge ? 2 : 1);
+        int cycles = 0;
+        for(int l = 0 ; l <= last_level ; l++){
+            uint32_t index = (vaddr >> level_shift[l]) & ((1u << level_bits[l]) - 1);
+            cycles += access('r', getTable(l, vaddr) + index * PTE_SIZE);
+        }
+        map<uint32_t, uint32_t>& frames = huge ? huge_pages : pages;
+        int bits = huge ? huge_bits : page_bits;
+        uint32_t vpn = vaddr >> bits;
+        if(frames.find(vpn) == frames.end()) frames[vpn] = allocPhys(1u << bits, 1u << bits);
+        entry.phys_base = frames[vpn];
+        entry.huge = huge;
+        walkCount++;
+        walkCycles += cycles;
+        *acc_time += cycles;
+    }
+
+    // fill the levels that missed
+    for(int i = 0 ; i < hit_level ; i++){
+        tlbs[i].insert(vaddr, entry.huge, entry.phys_base);
+    }
+    uint32_t offset_mask = (1u << (entry.huge ? huge_bits : page_bits)) - 1;
+    return entry.phys_base | (vaddr & offset_mask);
+}
+
+#endif // _TLB_H